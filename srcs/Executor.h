@@ -0,0 +1,234 @@
+/* A work-stealing executor for graphs of tensor assignments.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TaskGraph.h"
+
+namespace Mosquito {
+
+  /**
+   * \brief Runs the assignments of a TaskGraph on several threads.
+   *
+   * The worker threads are created once, with the executor, and sleep
+   * between runs so that small graphs can be run repeatedly without the
+   * cost of starting threads. The thread calling run() takes part in the
+   * work. Each worker keeps its own queue of ready assignments and, when
+   * it runs out, steals from the queues of the others.
+   *
+   * A worker which finds nothing to run yields for a few attempts, then
+   * sleeps until an assignment is queued or the run completes. Cores are
+   * therefore not kept busy while waiting on a long kernel or a chain of
+   * dependent assignments, at the cost of a wake-up when work appears.
+   */
+  class Executor {
+    public:
+      /**
+       * \brief Constructor.
+       *
+       * Starts the worker threads.
+       * \param NumThreads The number of threads to run on, including the
+       * calling thread. If zero, the number of hardware threads is used.
+       */
+      Executor(int NumThreads = 0);
+
+      /**
+       * \brief Destructor. Stops the worker threads.
+       */
+      ~Executor();
+
+      /**
+       * \brief Run all the assignments in a graph
+       *
+       * Returns once every assignment has completed. The results are the
+       * same as those of TaskGraph::run(). Only one graph may be run at a
+       * time.
+       *
+       * If a kernel throws, the assignments which have not yet started are
+       * skipped, and once those already running have finished the first
+       * exception thrown is rethrown here. The executor may then be used
+       * again.
+       * \param graph The graph to run.
+       */
+      void run(const TaskGraph& graph);
+
+      /**
+       * \brief The number of threads used, including the calling thread.
+       *
+       * \retval num The number of threads
+       */
+      int getNumThreads() const;
+
+    private:
+      /**
+       * \brief The ready assignments of one worker.
+       *
+       * The owner works from the back, thieves take from the front.
+       */
+      struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+      };
+
+      /**
+       * \brief Not copyable.
+       */
+      Executor(const Executor &executor);
+
+      /**
+       * \brief Not assignable.
+       */
+      Executor &operator=(const Executor &executor);
+
+      /**
+       * \brief The loop run by each worker thread.
+       * \param worker The number of the worker.
+       */
+      void work(int worker);
+
+      /**
+       * \brief Run ready assignments until the graph is complete.
+       * \param worker The number of the worker.
+       */
+      void drain(int worker);
+
+      /**
+       * \brief Run an assignment and release the ones waiting on it.
+       *
+       * Exceptions thrown by the kernel are caught and kept in error.
+       * \param worker The number of the worker.
+       * \param task The assignment to run.
+       */
+      void execute(int worker, int task);
+
+      /**
+       * \brief Add a ready assignment to a worker's queue.
+       *
+       * Wakes a sleeping worker, if there is one.
+       */
+      void push(int worker, int task);
+
+      /**
+       * \brief Sleep until an assignment is queued or the run completes.
+       */
+      void idle();
+
+      /**
+       * \brief Take the most recent assignment from a worker's own queue.
+       * \retval found Whether an assignment was found.
+       */
+      bool pop(int worker, int& task);
+
+      /**
+       * \brief Take the oldest assignment from another worker's queue.
+       * \retval found Whether an assignment was found.
+       */
+      bool steal(int worker, int& task);
+
+      /**
+       * \brief The number of threads, including the calling thread.
+       */
+      int numThreads;
+
+      /**
+       * \brief The worker threads, numbered from 1.
+       */
+      std::vector<std::thread> threads;
+
+      /**
+       * \brief One queue per worker, the calling thread being worker 0.
+       */
+      Queue* queues;
+
+      /**
+       * \brief The graph being run.
+       */
+      const TaskGraph* graph;
+
+      /**
+       * \brief The number of unfinished predecessors of each assignment.
+       */
+      std::atomic<int>* pending;
+
+      /**
+       * \brief The size of the pending array.
+       */
+      int pendingSize;
+
+      /**
+       * \brief The number of assignments not yet completed.
+       */
+      std::atomic<int> remaining;
+
+      /**
+       * \brief The number of assignments in all the queues.
+       */
+      std::atomic<int> queued;
+
+      /**
+       * \brief The number of workers sleeping in idle().
+       */
+      std::atomic<int> sleeping;
+
+      /**
+       * \brief Protects the sleep of idle workers.
+       */
+      std::mutex idleMutex;
+
+      /**
+       * \brief Wakes idle workers when an assignment is queued, the run
+       * completes or the executor stops.
+       */
+      std::condition_variable ready;
+
+      /**
+       * \brief Set when a kernel has thrown during the current run.
+       *
+       * Kernels of the assignments which start after this is set are
+       * skipped, so that the run drains quickly.
+       */
+      std::atomic<bool> failed;
+
+      /**
+       * \brief The first exception thrown by a kernel in the current run.
+       */
+      std::exception_ptr error;
+
+      /**
+       * \brief Protects generation, stopping and error.
+       */
+      std::mutex mutex;
+
+      /**
+       * \brief Wakes the workers when a run starts or the executor stops.
+       */
+      std::condition_variable wake;
+
+      /**
+       * \brief Counts the runs, so that workers can tell a new one began.
+       */
+      unsigned long generation;
+
+      /**
+       * \brief Set when the workers should exit.
+       */
+      std::atomic<bool> stopping;
+  };
+};
+
+#endif
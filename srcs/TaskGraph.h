@@ -0,0 +1,216 @@
+/* A dependency graph of tensor assignments.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ */
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <functional>
+#include <list>
+#include <vector>
+#include "Tensor.h"
+#include "TensorList.h"
+
+namespace Mosquito {
+
+  class Executor;
+
+  /**
+   * \brief A batch of tensor assignments and the dependencies between them.
+   *
+   * Each assignment writes one target Tensor and reads a list of operand
+   * Tensors. The graph compares the component storage of the operands of
+   * every assignment with that of the earlier assignments, so the
+   * assignments are ordered exactly as they would be if evaluated one
+   * after the other in the order they were added. Assignments which do not
+   * share storage are independent and may be run concurrently by an
+   * Executor. Tensors constructed on parts of the same external array are
+   * compared by the components they actually cover. The entries of a
+   * TensorList each own their storage; a whole list is passed as an
+   * operand with the TensorList form of assign().
+   *
+   * The graph is built once and may be run any number of times, for
+   * instance once per evaluation of a right hand side:
+   * @code
+   *  TaskGraph graph;
+   *  Tensor& gammaDown = graph.intermediate("_a_b_c");
+   *  graph.assign(gammaDown, {&dg}, [&]{
+   *    gammaDown["abc"] = 0.5*(dg["bac"] + dg["cab"] - dg["abc"]);
+   *  });
+   *  graph.assign(gamma, {&gInv, &gammaDown}, [&]{
+   *    gamma["abc"] = gInv["ad"]*gammaDown["dbc"];
+   *  });
+   *  Executor executor(4);
+   *  executor.run(graph);
+   * @endcode
+   * The kernels are called long after the statement that added them, so
+   * they must only refer to objects which outlive the graph.
+   */
+  class TaskGraph {
+    public:
+      /**
+       * \brief The code performing a single assignment.
+       */
+      typedef std::function<void()> Kernel;
+
+      /**
+       * \brief Constructor.
+       *
+       * Creates an empty TaskGraph.
+       */
+      TaskGraph();
+
+      /**
+       * \brief Add an assignment to the graph
+       *
+       * The assignment depends on every earlier assignment which writes
+       * the storage of one of its operands or of its target, or which reads
+       * the storage of its target.
+       *
+       * The dependencies are worked out from the target and operands alone,
+       * never from the kernel. Every tensor the kernel reads must be
+       * listed, and the kernel must write nothing but the target.
+       * Otherwise the kernel may race with other assignments, and the
+       * behaviour is undefined. run() checks for undeclared writes in
+       * debug builds.
+       * \param target The tensor written by the kernel.
+       * \param operands The tensors read by the kernel.
+       * \param kernel The code performing the assignment.
+       * \retval task The number of the new assignment in the graph.
+       */
+      int assign(Tensor& target, const std::vector<const TensorBase*>& operands,
+          const Kernel& kernel);
+
+      /**
+       * \brief Add an assignment which reads a whole TensorList
+       *
+       * As assign() above, with every tensor in the list added to the
+       * operands. Useful for kernels which read the whole evolved state.
+       * \param target The tensor written by the kernel.
+       * \param list The list of tensors read by the kernel.
+       * \param operands Any other tensors read by the kernel.
+       * \param kernel The code performing the assignment.
+       * \retval task The number of the new assignment in the graph.
+       */
+      int assign(Tensor& target, const TensorList& list,
+          const std::vector<const TensorBase*>& operands, const Kernel& kernel);
+
+      /**
+       * \brief Create a tensor owned by the graph
+       *
+       * A convenience for temporaries, which lives as long as the graph. The
+       * graph does not find common subexpressions itself: a result needed
+       * by several assignments is computed once only if it is assigned to
+       * such a tensor, which is then listed as an operand of each of them.
+       * \param indexString The character array defining the tensor type.
+       * \retval tensor The new tensor, with all components zero.
+       */
+      Tensor& intermediate(const char* indexString);
+
+      /**
+       * \brief The number of assignments in the graph
+       *
+       * \retval num The number of assignments
+       */
+      int getNumTasks() const;
+
+      /**
+       * \brief The number of assignments which must complete before one
+       * may start
+       *
+       * \param task The number of the assignment, as returned by assign().
+       * \retval num The number of assignments it waits for
+       */
+      int getNumPredecessors(int task) const;
+
+      /**
+       * \brief Run every assignment in order on the calling thread
+       *
+       * Unless NDEBUG is defined, the components of every tensor in the
+       * graph are compared before and after each kernel, and an assertion
+       * fails if the kernel changed any but those of its target. This
+       * catches writes which are missing from the graph; reads cannot be
+       * checked, nor writes to tensors the graph does not know about. The
+       * check makes this slow, so it is meant to be run once on a new
+       * graph before it is handed to an Executor.
+       */
+      void run() const;
+
+    private:
+      friend class Executor;
+
+      /**
+       * \brief Not copyable.
+       *
+       * A copy would share the kernels, and the regions of the
+       * intermediates, of the original.
+       */
+      TaskGraph(const TaskGraph &graph);
+
+      /**
+       * \brief Not assignable.
+       */
+      TaskGraph &operator=(const TaskGraph &graph);
+
+      /**
+       * \brief A contiguous range of tensor components.
+       */
+      struct Region {
+        const double* begin;
+        const double* end;
+      };
+
+      /**
+       * \brief A single assignment and its edges in the graph.
+       */
+      struct Task {
+        Kernel kernel;
+        Region write;
+        std::vector<Region> reads;
+        std::vector<int> successors;
+        int numPredecessors;
+      };
+
+      /**
+       * \brief Returns the storage of a tensor.
+       * \param tensor The tensor.
+       * \retval region The range of its components.
+       */
+      static Region region(const TensorBase& tensor);
+
+      /**
+       * \brief Whether two ranges of components overlap.
+       */
+      static bool overlap(const Region& a, const Region& b);
+
+      /**
+       * \brief Whether task b must wait for the earlier task a.
+       */
+      static bool depends(const Task& a, const Task& b);
+
+      /**
+       * \brief The assignments, in the order in which they were added.
+       */
+      std::vector<Task> tasks;
+
+      /**
+       * \brief The tasks which depend on no other, in order.
+       */
+      std::vector<int> roots;
+
+      /**
+       * \brief Storage for the intermediate tensors.
+       *
+       * A list, so that references to the tensors remain valid.
+       */
+      std::list<Tensor> intermediates;
+  };
+};
+
+#endif
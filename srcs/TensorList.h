@@ -15,6 +15,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include "Tensor.h"
 
 namespace Mosquito {
@@ -81,6 +82,15 @@ namespace Mosquito {
        */
       int getNumComponents() const;
 
+      /**
+       * \brief Get pointers to all tensors in the list
+       *
+       * The pointers are appended to the vector, in the same order as the
+       * components are copied by getComponents().
+       * \param list The vector to append the tensors to.
+       */
+      void getTensors(std::vector<const TensorBase*>& list) const;
+
     private:
       /**
        * The Tensor objects in the TensorList